@@ -1,195 +1,796 @@
 #include <SDL2/SDL.h>
-#include <SDLShapes.hpp>
 #include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <string>
 #include <vector>
 #include <array>
 #include <memory>
 #include <time.h>
+#include <dirent.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <emmintrin.h>
+#define CHIP8_SSE2 1
+#endif
 
 #define SCALE 11
+#ifdef CHIP8_PROFILE
+constexpr bool kProfile = true; // Build with -DCHIP8_PROFILE (make chip8emu-prof.exe)
+#else
+constexpr bool kProfile = false;
+#endif
 typedef uint8_t u8;
 typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+__extension__ typedef unsigned __int128 u128; // One full 128-wide SCHIP row
 
-template<typename T = u8, int size = 4096>
+/* Bounds policies for Memory: checked masks every address into range so a
+* bad ROM wraps instead of corrupting the host (size must be a power of
+* two); unchecked is for benchmark/turbo builds running trusted ROMs.
+*/
+struct BoundsChecked { static constexpr bool checked = true; };
+struct BoundsUnchecked { static constexpr bool checked = false; };
+#ifdef CHIP8_UNCHECKED
+using DefaultBounds = BoundsUnchecked;
+#else
+using DefaultBounds = BoundsChecked;
+#endif
+
+template<typename T = u8, int size = 4096, typename Bounds = DefaultBounds>
 class Memory {
 	std::array<T, size> memory; // 4K of Memory
+	static u16 clip(u16 addr) {
+		if constexpr (Bounds::checked)
+			addr &= size - 1;
+		return addr;
+	}
+	static size_t span(u16 addr, size_t len) { // Clamp a copy to the array end
+		if constexpr (Bounds::checked)
+			if (len > size_t(size) - addr)
+				len = size_t(size) - addr;
+		return len;
+	}
 public:
 	Memory() { memory = {}; }
-	u8 RB(u16 addr) { return (u8 &)memory[addr]; } // Read data from address
-	void WB(u16 addr, const u8 & value) { memory[addr] = value; } // Write to address
+	u8 RB(u16 addr) { return memory[clip(addr)]; } // Read data from address
+	void WB(u16 addr, const u8 & value) { memory[clip(addr)] = value; } // Write to address
+	u16 RW(u16 addr) { // Opcode fetch: one 16-bit load (little-endian host)
+		addr = clip(addr);
+		if constexpr (Bounds::checked) {
+			if (addr + 1 >= size) // Fetch straddling the top byte; cold
+				return u16((memory[addr] << 8) | memory[0]);
+		}
+		u16 w;
+		memcpy(&w, &memory[addr], sizeof w);
+		return u16((w << 8) | (w >> 8)); // Chip8 opcodes are big-endian
+	}
+	void load(u16 addr, const T* src, size_t len) { // Bulk copy into memory
+		addr = clip(addr);
+		memcpy(&memory[addr], src, span(addr, len) * sizeof(T));
+	}
+	void dump(u16 addr, T* dst, size_t len) const { // Bulk copy out of memory
+		addr = clip(addr);
+		memcpy(dst, &memory[addr], span(addr, len) * sizeof(T));
+	}
+	const T* window(u16 addr, size_t len) const { // Zero-copy view of len elements
+		if constexpr (Bounds::checked) {
+			addr &= size - 1;
+			if (len > size_t(size) - addr) // Slide back so the whole view is in range
+				addr = u16(size - len);
+		}
+		return &memory[addr];
+	}
 };
 
-class Stack : public std::vector<u16> {
-public:
-	void pop(u16 &pc) {
-		pc = this->back();
-		this->pop_back();
+/* Row expansion: 1 bit per pixel to ARGB texels for the streaming texture.
+* Walking the word bit by bit is 2048 branchy iterations per hires frame,
+* so the work goes 8 pixels at a time instead: a 256-entry per-byte lookup
+* table (one memcpy per byte) as the portable path, and an SSE2 bit-unpack
+* where the host has it. The kernel is picked once through a function
+* pointer, so the presenter never branches on the CPU again.
+*/
+using ExpandRowFn = void (*)(const u64* words, Uint32* out, unsigned width);
+
+struct ExpandLut { // 256 bytes x 8 precomputed texels, built once
+	Uint32 rows[256][8];
+	ExpandLut() {
+		for (unsigned b = 0; b < 256; ++b)
+			for (unsigned bit = 0; bit < 8; ++bit)
+				rows[b][bit] = ((b >> (7 - bit)) & 1) ? 0xffffffff : 0xff000000;
 	}
 };
 
+void expandRowLut(const u64* words, Uint32* out, unsigned width) {
+	static const ExpandLut lut;
+	for (unsigned x = 0; x < width; x += 8) {
+		u8 byte = u8(words[x >> 6] >> (56 - (x & 63)));
+		memcpy(&out[x], lut.rows[byte], sizeof lut.rows[byte]);
+	}
+}
+
+#ifdef CHIP8_SSE2
+__attribute__((target("sse2")))
+void expandRowSse2(const u64* words, Uint32* out, unsigned width) {
+	// Broadcast each byte and test one bit per 32-bit lane; a set bit
+	// compares to all-ones, which is already the white texel
+	const __m128i black = _mm_set1_epi32(int(0xff000000));
+	const __m128i hi = _mm_set_epi32(0x10, 0x20, 0x40, 0x80); // Pixels 0-3
+	const __m128i lo = _mm_set_epi32(0x01, 0x02, 0x04, 0x08); // Pixels 4-7
+	for (unsigned x = 0; x < width; x += 8) {
+		__m128i b = _mm_set1_epi32(int(u8(words[x >> 6] >> (56 - (x & 63)))));
+		__m128i m0 = _mm_cmpeq_epi32(_mm_and_si128(b, hi), hi);
+		__m128i m1 = _mm_cmpeq_epi32(_mm_and_si128(b, lo), lo);
+		_mm_storeu_si128((__m128i*)&out[x], _mm_or_si128(m0, _mm_andnot_si128(m0, black)));
+		_mm_storeu_si128((__m128i*)&out[x + 4], _mm_or_si128(m1, _mm_andnot_si128(m1, black)));
+	}
+}
+#endif
+
+ExpandRowFn pickExpandRow() { // Resolved at startup; the table is the fallback
+#ifdef CHIP8_SSE2
+	if (__builtin_cpu_supports("sse2"))
+		return expandRowSse2;
+#endif
+	return expandRowLut;
+}
+ExpandRowFn expandRow = pickExpandRow();
+
 struct SDL_Deleter {
 	void operator()(SDL_Surface* ptr) { SDL_FreeSurface(ptr); }
 	void operator()(SDL_Window* ptr) { SDL_DestroyWindow(ptr); }
+	void operator()(SDL_Renderer* ptr) { SDL_DestroyRenderer(ptr); }
+	void operator()(SDL_Texture* ptr) { SDL_DestroyTexture(ptr); }
 };
 
 class Display {
 	std::unique_ptr<SDL_Window, SDL_Deleter> win;
-	std::unique_ptr<SDL_Surface> surfBuffer;
-	std::unique_ptr<SDL_Surface> winSurface;
-	std::array<u8, 256> screenPixels{};
-	/* Screen Resolution of the chip8 is 64(h) x 32(v)
-	* Each row consists of 8 bytes of data. So to get
-	* to the next row the height value multiplied by
-	* the 8 to adjust for the correct height
+	std::unique_ptr<SDL_Renderer, SDL_Deleter> renderer;
+	std::unique_ptr<SDL_Texture, SDL_Deleter> texture;
+	std::array<Uint32, 128 * 64> texPixels{}; // ARGB staging buffer, one texel per chip8 pixel
+	std::array<u64, 128> rows{}; // Two 64-bit words per row; lores uses word [2r] of rows 0-31
+	std::atomic<u64> dirtyRows{ ~0ull }; // Bit n set == row n needs re-rasterizing
+	std::atomic<bool> hires{ false }; // SCHIP 128x64 mode (00FF) vs 64x32 (00FE)
+	/* Lores is 64(h) x 32(v): one 64-bit word per row, bit 63 is x == 0,
+	* so a sprite line lands as a single shift + XOR on that word. Hires
+	* (SCHIP) is 128 x 64 with two words per row, handled as one 128-bit
+	* op per line.
+	*
+	* Presenting runs on its own thread: the emulation thread XORs into
+	* rows under a seqlock and the presenter snapshots them (1 KB) and
+	* does the texture upload / present on its own 60 hz cadence.
 	*/
+	std::atomic<u32> seq{ 0 }; // Seqlock generation; odd == writer active
+	std::atomic<unsigned> frameSkip{ 1 }; // Present every Kth presenter tick
+	std::atomic<bool> presenterRun{ false };
+	std::thread presenter;
+	bool headless; // No SDL video, presenting is disabled (benchmarks / batch runs)
 public:
-	Display() {
-		SDL_Init(SDL_INIT_EVERYTHING);
+	Display(bool headlessMode = false) : headless(headlessMode) {
+		if (headless)
+			return;
+		SDL_Init(SDL_INIT_VIDEO | SDL_INIT_EVENTS); // Only the subsystems we use
+		SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest"); // Keep the chip8 pixels crisp
 		win.reset(SDL_CreateWindow(
 			"Chip8 Interpreter", // Title
 			SDL_WINDOWPOS_UNDEFINED, // Window Start X
 			SDL_WINDOWPOS_UNDEFINED, // Window Start Y
 			64 * SCALE, // Window width
 			32 * SCALE, // Window height
-			0)); // Window Flags 
-		winSurface.reset(SDL_GetWindowSurface(win.get()));
-		surfBuffer.reset(SDL_ConvertSurface(winSurface.get(), winSurface.get()->format, 0));
+			0)); // Window Flags
+		renderer.reset(SDL_CreateRenderer(win.get(), -1, SDL_RENDERER_ACCELERATED));
+		texture.reset(SDL_CreateTexture(renderer.get(), SDL_PIXELFORMAT_ARGB8888,
+			SDL_TEXTUREACCESS_STREAMING, 64, 32)); // GPU does the SCALE-factor upscale
+		if (isInit()) {
+			presenterRun.store(true, std::memory_order_release);
+			presenter = std::thread(&Display::presentLoop, this);
+		}
 	}
-	/*
+
 	~Display() {
-	win.reset();
-	winSurface.reset();
-	surfBuffer.reset();
+		stopPresenter();
+	}
+
+	void stopPresenter() { // Idempotent; must run before SDL_Quit
+		if (presenter.joinable()) {
+			presenterRun.store(false, std::memory_order_release);
+			presenter.join();
+		}
 	}
-	*/
 
 	bool isInit() {
+		if (headless) { return true; }
 		if (win.get() == nullptr) { printf("Window did not initialize!\n"); return false; }
-		if (winSurface.get() == nullptr) { printf("Surface did not initialize!\n"); return false; }
-		if (surfBuffer.get() == nullptr) { printf("Surface did not initialize!\n"); return false; }
+		if (renderer.get() == nullptr) { printf("Renderer did not initialize!\n"); return false; }
+		if (texture.get() == nullptr) { printf("Texture did not initialize!\n"); return false; }
 		return true;
 	}
 
 	void clear() {
-		for (int i = 0; i < 256; ++i) {
-			screenPixels[i] = 0;
-		}
+		seq.fetch_add(1, std::memory_order_release);
+		rows.fill(0);
+		seq.fetch_add(1, std::memory_order_release);
+		dirtyRows.fetch_or(~0ull, std::memory_order_release);
+	}
+
+	void markDirty(unsigned row) {
+		dirtyRows.fetch_or(1ull << row, std::memory_order_release);
+	}
+
+	void markAllDirty() {
+		dirtyRows.fetch_or(~0ull, std::memory_order_release);
 	}
 
-	bool predrawSurf(const u16 & addr, Memory<u8> & RAM, const u8 & nBytes, const u8 & x, const u8 & y) {
+	bool isHires() const { return hires.load(std::memory_order_relaxed); }
+	unsigned screenHeight() const { return isHires() ? 64 : 32; }
+
+	void setFrameSkip(unsigned k) { frameSkip.store(k ? k : 1, std::memory_order_relaxed); }
+
+	void setHires(bool on) { // 00FE / 00FF; mode switches clear the screen
+		hires.store(on, std::memory_order_release);
+		clear();
+	}
+
+	const std::array<u64, 128> & framebuffer() const { return rows; }
+
+	void setFramebuffer(const std::array<u64, 128> & src, bool hiresMode) { // Savestate restore
+		hires.store(hiresMode, std::memory_order_release);
+		seq.fetch_add(1, std::memory_order_release);
+		rows = src;
+		seq.fetch_add(1, std::memory_order_release);
+		markAllDirty();
+	}
+
+	bool predrawSurf(const u8* sprite, const u8 & nBytes, const u8 & x, const u8 & y) {
 		bool collision = false;
-		unsigned xOffset = (x % 8);
-		unsigned xByte = x / 8;
-
-
-		if /*constexpr*/ (xOffset == 0) { // If the sprite is alligned with memory
-			for (int i = 0; i < nBytes; ++i) { // Draw sprite line by line
-				//unsigned yAdj = (y + i) % 32;
-				unsigned yAdj = (y * 8 + i * 8) % 256;
-				u8 nextByte = RAM.RB(addr + i);
-				unsigned arrayInx = xByte + yAdj;
-				screenPixels[arrayInx] = nextByte ^ screenPixels[arrayInx];
-				if (screenPixels[arrayInx] != nextByte) { collision = true; }
+		bool hi = isHires();
+		unsigned height = hi ? 64 : 32;
+		unsigned xPos = x & (hi ? 127 : 63);
+		unsigned nLines = nBytes ? nBytes : 16; // DXY0 == 16-line SCHIP sprite
+		bool wide = (nBytes == 0) && hi; // 16 pixels per line, two bytes each
+		seq.fetch_add(1, std::memory_order_release); // Seqlock write section
+		for (unsigned i = 0; i < nLines; ++i) { // Draw sprite line by line
+			unsigned row = (y + i) & (height - 1);
+			if (!hi) {
+				u64 line = u64(sprite[i]) << 56;
+				if (xPos) // Rotate so sprites wrap around the right edge
+					line = (line >> xPos) | (line << (64 - xPos));
+				if (rows[row * 2] & line) { collision = true; }
+				rows[row * 2] ^= line;
 			}
+			else { // One 128-bit shift + XOR per line
+				u64 lineBits = wide ? (u64(sprite[i * 2]) << 8) | sprite[i * 2 + 1] : sprite[i];
+				u128 line = u128(lineBits) << (wide ? 112 : 120);
+				if (xPos)
+					line = (line >> xPos) | (line << (128 - xPos));
+				u128 rowVal = (u128(rows[row * 2]) << 64) | rows[row * 2 + 1];
+				if (rowVal & line) { collision = true; }
+				rowVal ^= line;
+				rows[row * 2] = u64(rowVal >> 64);
+				rows[row * 2 + 1] = u64(rowVal);
+			}
+			markDirty(row);
 		}
-		else {
-			/*
-			u8 maskT = (1u << xOffset) - 1u;
-			*/
-			u8 maskT = 0xff >> xOffset;
-			u8 maskB = ~maskT;
-			if /*constexpr*/ (x > 7 * 8)
-				for (int i = 0; i < nBytes; ++i) { // If the sprite is slightly off the screen on the x axis
-					u8 nextByte = RAM.RB(addr + i);
-					//unsigned yAdj = (y + i) % 32;
-					unsigned yAdj = (y * 8 + i * 8) % 256;
-					unsigned arrayInx = 7 + yAdj;
-					screenPixels[arrayInx] = ((nextByte >> xOffset) & maskT) ^ screenPixels[arrayInx];
-					screenPixels[yAdj] = ((nextByte << (8 - xOffset) & maskB) ^ screenPixels[yAdj]);
-					if (screenPixels[arrayInx] != maskT) { collision = true; }
-					else if (screenPixels[yAdj] != maskB) { collision = true; }
-				}
-			else
-				for (int i = 0; i < nBytes; ++i) {
-					u8 nextByte = RAM.RB(addr + i);
-					//unsigned yAdj = (y + i) % 32
-					unsigned yAdj = (y * 8 + i * 8) % 256;
-					unsigned arrInxHi = (x / 8) + yAdj;
-					unsigned arrInxLo = arrInxHi + 1;
-					screenPixels[arrInxHi] = ((nextByte >> xOffset) & maskT) ^ screenPixels[arrInxHi];
-					screenPixels[arrInxLo] = ((nextByte << (8 - xOffset) & maskB) ^ screenPixels[arrInxLo]);
-					if (screenPixels[arrInxHi] != maskT) { collision = true; }
-					else if (screenPixels[arrInxLo] != maskB) { collision = true; }
-				}
-		}
+		seq.fetch_add(1, std::memory_order_release);
 		return collision;
 	}
 
-	void DrawScaledPix(SDL_Surface* surf, const int &x, const int &y) {
-		for (int i = 0; i < SCALE; ++i) {
-			for (int j = 0; j < SCALE; j++) {
-				sp::DrawPixel(surf, (x * SCALE) + i, (y * SCALE) + j);
-			}
+	void scrollDown(unsigned n) { // 00Cn: whole-word row moves, no pixel walks
+		unsigned height = screenHeight();
+		seq.fetch_add(1, std::memory_order_release);
+		for (int r = height - 1; r >= int(n); --r) {
+			rows[r * 2] = rows[(r - n) * 2];
+			rows[r * 2 + 1] = rows[(r - n) * 2 + 1];
+		}
+		for (unsigned r = 0; r < n && r < height; ++r) {
+			rows[r * 2] = rows[r * 2 + 1] = 0;
+		}
+		seq.fetch_add(1, std::memory_order_release);
+		markAllDirty();
+	}
+
+	void scrollRight() { // 00FB: 4 pixels right, one shift pair per row
+		unsigned height = screenHeight();
+		seq.fetch_add(1, std::memory_order_release);
+		for (unsigned r = 0; r < height; ++r) {
+			rows[r * 2 + 1] = (rows[r * 2 + 1] >> 4) | (rows[r * 2] << 60);
+			rows[r * 2] >>= 4;
+		}
+		seq.fetch_add(1, std::memory_order_release);
+		markAllDirty();
+	}
+
+	void scrollLeft() { // 00FC: 4 pixels left
+		unsigned height = screenHeight();
+		seq.fetch_add(1, std::memory_order_release);
+		for (unsigned r = 0; r < height; ++r) {
+			rows[r * 2] = (rows[r * 2] << 4) | (rows[r * 2 + 1] >> 60);
+			rows[r * 2 + 1] <<= 4;
 		}
+		seq.fetch_add(1, std::memory_order_release);
+		markAllDirty();
 	}
 
-	void draw() {
-		SDL_FillRect(surfBuffer.get(), NULL, 0); // Clear Buffer Screen
-		for (int i = 0; i < 256; ++i) // Check all bytes in screenPixels array
-			for (int j = 7; j >= 0; --j) { // Check bits of the byte
-				u8 bitMask = 1u << j;
-				bool pixBit = screenPixels[i] & bitMask;
-				if(pixBit) {
-					DrawScaledPix(surfBuffer.get(), (i % 8) * 8 + (7 - j), i / 8);
-					//sp::DrawPixel(surfBuffer.get(), (i % 64) + j, i / 64);
+	void presentLoop() { // Presenter thread: snapshot, rasterize, present at ~60 hz
+		std::array<u64, 128> snap;
+		bool texHires = false; // Mode the current texture was created for
+		unsigned tick = 0;
+		while (presenterRun.load(std::memory_order_acquire)) {
+			unsigned skip = frameSkip.load(std::memory_order_relaxed);
+			if (skip > 1 && (++tick % skip) != 0) { // Turbo frame skip; dirt accumulates
+				std::this_thread::sleep_for(std::chrono::milliseconds(16));
+				continue;
+			}
+			u64 mask = dirtyRows.exchange(0, std::memory_order_acquire);
+			bool hi = hires.load(std::memory_order_acquire);
+			if (hi != texHires) { // Mode switch: match the texture, repaint everything
+				texHires = hi;
+				texture.reset(SDL_CreateTexture(renderer.get(), SDL_PIXELFORMAT_ARGB8888,
+					SDL_TEXTUREACCESS_STREAMING, hi ? 128 : 64, hi ? 64 : 32));
+				mask = ~0ull;
+			}
+			if (mask) {
+				u32 s0, s1;
+				do { // Seqlock: retry if the emulation thread wrote mid-copy
+					s0 = seq.load(std::memory_order_acquire);
+					snap = rows;
+					s1 = seq.load(std::memory_order_acquire);
+				} while (s0 != s1 || (s0 & 1));
+				unsigned height = hi ? 64 : 32;
+				unsigned width = hi ? 128 : 64;
+				for (unsigned row = 0; row < height; ++row) {
+					if (!(mask & (1ull << row)))
+						continue;
+					Uint32* texRow = &texPixels[row * width];
+					expandRow(&snap[row * 2], texRow, width); // LUT or SSE2 kernel
+					SDL_Rect rowRect = { 0, int(row), int(width), 1 }; // One texel per pixel
+					SDL_UpdateTexture(texture.get(), &rowRect, texRow, width * sizeof(Uint32));
 				}
+				SDL_RenderCopy(renderer.get(), texture.get(), NULL, NULL);
+				SDL_RenderPresent(renderer.get()); // Vsync stalls land here, not on emulation
+			}
+			std::this_thread::sleep_for(std::chrono::milliseconds(16));
+		}
+	}
+};
+
+class NullDisplay {
+	/* Display policy for compute-only builds: same surface as Display, but
+	* every call is an inlineable no-op the optimizer can hoist. The
+	* framebuffer array is kept so savestates still round-trip.
+	*/
+	std::array<u64, 128> rows{};
+	bool hires{ false };
+public:
+	NullDisplay(bool = false) {}
+	void stopPresenter() {}
+	void setFrameSkip(unsigned) {}
+	bool isInit() { return true; }
+	void clear() {}
+	void markDirty(unsigned) {}
+	void markAllDirty() {}
+	bool isHires() const { return hires; }
+	unsigned screenHeight() const { return isHires() ? 64 : 32; }
+	void setHires(bool on) { hires = on; }
+	const std::array<u64, 128> & framebuffer() const { return rows; }
+	void setFramebuffer(const std::array<u64, 128> & src, bool hiresMode) {
+		rows = src;
+		hires = hiresMode;
+	}
+	bool predrawSurf(const u8*, const u8 &, const u8 &, const u8 &) { return false; }
+	void scrollDown(unsigned) {}
+	void scrollRight() {}
+	void scrollLeft() {}
+};
+
+class AudioEngine {
+	/* The emulation thread never touches the audio device: ST transitions
+	* are pushed as beep events into a single-producer/single-consumer ring
+	* (one relaxed store, never a mutex), and the SDL audio callback drains
+	* the ring and synthesizes the square wave itself.
+	*/
+	struct Event { u8 on; u32 ms; };
+	std::array<Event, 64> ring;
+	std::atomic<u32> head{ 0 }, tail{ 0 }; // head: emulation thread, tail: callback
+	SDL_AudioDeviceID dev{ 0 };
+	int freq{ 48000 };
+	unsigned samplesLeft{ 0 }; // Beep samples still to synthesize
+	unsigned phase{ 0 };
+public:
+	AudioEngine(bool headless) {
+		if (headless)
+			return;
+		SDL_InitSubSystem(SDL_INIT_AUDIO);
+		SDL_AudioSpec want{}, have{};
+		want.freq = 48000;
+		want.format = AUDIO_S16SYS;
+		want.channels = 1;
+		want.samples = 512;
+		want.callback = &AudioEngine::callbackThunk;
+		want.userdata = this;
+		dev = SDL_OpenAudioDevice(NULL, 0, &want, &have, 0);
+		if (dev) {
+			freq = have.freq;
+			SDL_PauseAudioDevice(dev, 0);
+		}
+	}
+
+	~AudioEngine() {
+		if (dev)
+			SDL_CloseAudioDevice(dev);
+	}
+
+	void push(bool on, u32 ms) { // Producer side; drops events if the ring is full
+		if (!dev)
+			return;
+		u32 h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) >= ring.size())
+			return;
+		ring[h % ring.size()] = { u8(on), ms };
+		head.store(h + 1, std::memory_order_release);
+	}
+
+	static void callbackThunk(void* userdata, Uint8* stream, int len) {
+		((AudioEngine*)userdata)->callback(stream, len);
+	}
+
+	void callback(Uint8* stream, int len) { // Runs on the SDL audio thread
+		u32 h = head.load(std::memory_order_acquire);
+		u32 t = tail.load(std::memory_order_relaxed);
+		while (t != h) { // Latest event wins; a beep is (duration, on/off)
+			Event e = ring[t % ring.size()];
+			samplesLeft = e.on ? unsigned(u64(e.ms) * freq / 1000) : 0;
+			++t;
+		}
+		tail.store(t, std::memory_order_release);
+		int16_t* out = (int16_t*)stream;
+		int samples = len / 2;
+		const unsigned period = freq / 440; // Beep pitch
+		for (int s = 0; s < samples; ++s) {
+			if (samplesLeft) {
+				out[s] = (phase < period / 2) ? 3000 : -3000;
+				if (++phase >= period)
+					phase = 0;
+				--samplesLeft;
 			}
-		SDL_BlitSurface(surfBuffer.get(), 0, winSurface.get(), 0);
-		SDL_UpdateWindowSurface(win.get());
+			else
+				out[s] = 0;
+		}
 	}
 };
 
-struct Chip8 { // Chip 8 Processor: Originally an interpreter for the TELMAC
+struct TraceRec { // One executed instruction; fixed 20-byte layout, no formatting
+	u16 pc;
+	u16 opcode;
+	u8 regs[16];
+};
+
+class TraceWriter {
+	/* Execution tracing at interpreter speed: the emulation thread does a
+	* plain struct copy into a preallocated ring and bumps an atomic index;
+	* a background thread drains the ring to disk in multi-megabyte fwrites.
+	* File format: u32 magic, u32 version, then raw TraceRec records.
+	*/
+	static const u32 MAGIC = 0x43385452; // "C8TR"
+	static const size_t RING = 1u << 20; // Records; ~20 MB preallocated
+	static const u64 FLUSH_MIN = 1u << 16; // Do not bother the disk for less
+	std::vector<TraceRec> ring;
+	std::atomic<u64> head{ 0 }, tail{ 0 }; // head: emulation thread, tail: flusher
+	std::atomic<bool> run{ false };
+	std::thread flusher;
+	FILE* f{ nullptr };
+public:
+	~TraceWriter() { stop(); }
+
+	bool start(const char* path) {
+		f = fopen(path, "wb");
+		if (f == NULL)
+			return false;
+		u32 header[2] = { MAGIC, 1 };
+		fwrite(header, sizeof header, 1, f);
+		ring.resize(RING);
+		run.store(true, std::memory_order_release);
+		flusher = std::thread(&TraceWriter::flushLoop, this);
+		return true;
+	}
+
+	bool active() const { return run.load(std::memory_order_relaxed); }
+
+	void push(const TraceRec & r) { // Producer side; waits out the flusher if full
+		u64 h = head.load(std::memory_order_relaxed);
+		while (h - tail.load(std::memory_order_acquire) >= RING)
+			std::this_thread::yield();
+		ring[h & (RING - 1)] = r;
+		head.store(h + 1, std::memory_order_release);
+	}
+
+	void stop() { // Drains the ring, then closes the file
+		if (!flusher.joinable())
+			return;
+		run.store(false, std::memory_order_release);
+		flusher.join();
+		fclose(f);
+		f = nullptr;
+	}
+
+private:
+	void flushChunk() { // At most two fwrites: the span may wrap the ring
+		u64 h = head.load(std::memory_order_acquire);
+		u64 t = tail.load(std::memory_order_relaxed);
+		while (t < h) {
+			size_t n = size_t(h - t);
+			size_t contig = RING - size_t(t & (RING - 1));
+			if (n > contig)
+				n = contig;
+			fwrite(&ring[t & (RING - 1)], sizeof(TraceRec), n, f);
+			t += n;
+		}
+		tail.store(t, std::memory_order_release);
+	}
+
+	void flushLoop() {
+		while (run.load(std::memory_order_acquire)) {
+			if (head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed) >= FLUSH_MIN)
+				flushChunk();
+			else
+				std::this_thread::sleep_for(std::chrono::milliseconds(2));
+		}
+		flushChunk(); // Whatever was left when tracing stopped
+	}
+};
+
+struct ProfTimer { // Accumulates host time into a counter; compiles out when profiling is off
+	u64 & acc;
+	std::chrono::steady_clock::time_point t0;
+	ProfTimer(u64 & a) : acc(a) {
+		if constexpr (kProfile)
+			t0 = std::chrono::steady_clock::now();
+	}
+	~ProfTimer() {
+		if constexpr (kProfile)
+			acc += (std::chrono::steady_clock::now() - t0).count();
+	}
+};
+
+struct SaveState { // Fixed-layout snapshot; dumped/restored with a single I/O call
+	static const u32 MAGIC = 0x43385353; // "C8SS"
+	u32 magic;
+	u32 version;
+	u8 ram[4096];
+	u64 screen[128];
+	u16 stack[16];
+	u8 regs[16];
+	u16 stackDepth;
+	u16 i, pc;
+	u8 dt, st;
+	u8 hires;
+	u64 rngState;
+};
+
+/* Quirk profiles: compatibility-relevant opcode semantics differ between the
+* original COSMAC VIP interpreter and SCHIP. Following the Memory<T, size>
+* pattern, the core takes the profile as a template policy so each variant
+* compiles to branch-free specialized handlers.
+*/
+struct QuirksChip8 { // Original COSMAC VIP semantics
+	static constexpr bool shiftUsesVy = true; // 8xy6/8xyE shift Vy into Vx
+	static constexpr bool loadStoreIncrementsI = true; // Fx55/Fx65 leave I past the block
+	static constexpr bool jumpUsesVx = false; // Bnnn jumps to nnn + V0
+};
+struct QuirksSchip { // SCHIP 1.1 semantics
+	static constexpr bool shiftUsesVy = false; // Shift Vx in place
+	static constexpr bool loadStoreIncrementsI = false; // I is left unchanged
+	static constexpr bool jumpUsesVx = true; // Bxnn jumps to xnn + Vx
+};
+
+/* Input policies, same idea as the quirk profiles: the null version turns
+* the event-queue plumbing into dead code so compute-only ROMs never pay
+* for input they cannot receive.
+*/
+struct SdlInput { static constexpr bool enabled = true; };
+struct NullInput { static constexpr bool enabled = false; };
+
+template<typename Quirks = QuirksSchip, typename DisplayT = Display, typename Input = SdlInput>
+struct Chip8T { // Chip 8 Processor: Originally an interpreter for the TELMAC
 	std::array<u8, 16> regs{}; // General Registers from v0 - vf
-	std::array<bool, 16> io{ { false } };
+	u16 keyState{ 0 }; // Latched key bitmask, bit n == chip8 key n is held
 	// vf is used for a special flag
-	u8 dt{ 0 }, st{ 0 };	// Delay and Sound Timers
+	u8 dtLoad{ 0 }, stLoad{ 0 }; // Delay and Sound Timer values when loaded
+	Uint32 dtTick{ 0 }, stTick{ 0 }; // Load instants the timers count down from
 	u16 i{ 0 }; // Memory Index
 	u16 pc = 0x200; // Program Counter
-					//u8 sp; no need due to vector methods // Stack Pointer
-	Stack stack; // Stack which contains return addresses
-	Uint32 tickStart; // Begining of a cycle
-	Uint32 tickTimer; // Syncs timers to 50 hz
-	Display disp;
+	std::array<u16, 16> stack{}; // Return addresses; 16 levels is the hardware limit
+	u8 sp = 0; // Stack Pointer: next free slot
+	std::chrono::steady_clock::time_point clockEpoch; // Governor reference point
+	DisplayT disp;
+	AudioEngine audio;
+	TraceWriter trace;
 	Memory<u8> RAM;
 	unsigned clockCycle = 5000; // Hz
-	Uint32 cycleMax = 1000 / clockCycle;
+	unsigned long long cyclesRun = 0; // Instructions since clockEpoch
+	unsigned batchSize = 32; // Instructions between governor syncs
+	unsigned pollInterval = 32; // Cycles between SDL event polls
+	unsigned cyclesToPoll = 0; // Counts down to the next poll
+	unsigned cyclesToSync = 1; // Counts down to the next governor sync
 	bool running = true;
+	bool headless; // Skip input polling and presenting entirely
+	bool throttle = true; // When false the core runs flat out (bench mode)
+	bool turbo = false; // Hold-key fast-forward: governor suspended, frames skipped
+	unsigned speedMul = 1; // --speed N: governor runs at N * clockCycle
+	unsigned long long syncBase = 0; // cyclesRun when clockEpoch was last reset
+	u64 dtCycles{ 0 }, stCycles{ 0 }; // Timer load instants in emulated cycles
+	const char* haltReason = nullptr; // Why running went false, for batch reports
+	u64 rngState; // Per-instance xorshift64 state, no library call or lock
+	u64 rngSeedUsed; // Seed the run started from, stored in replay logs
+	/* Record/replay: every nondeterministic observation (key transitions,
+	* timer reads that changed value) is logged against the emulated cycle
+	* count, so feeding the log back reproduces a session exactly at
+	* unthrottled speed.
+	*/
+	struct ReplayEvent { u64 cycles; u8 type; u8 value; u16 keyBits; }; // type: 0 key, 1 dt, 2 st
+	std::vector<ReplayEvent> recLog;
+	std::vector<ReplayEvent> rpLog;
+	size_t rpNext = 0;
+	bool recording = false;
+	bool replaying = false;
+	u8 rpDt = 0, rpSt = 0; // Timer values as seen by the recorded run
+	u8 recLastDt = 0xff, recLastSt = 0xff; // Last logged values, 0xff == none yet
+	/* Debug surface: PC breakpoints and memory write watchpoints live in
+	* 4096-bit bitmaps, so an armed-but-not-hit check is one load and a
+	* test instead of a list walk. dbgActive is the single flag the hot
+	* path branches on; while nothing is armed it stays false and the
+	* checks are skipped entirely.
+	*/
+	bool dbgActive = false;
+	std::array<u64, 64> pcBreaks{}; // Bit addr set == break before executing addr
+	std::array<u64, 64> memWatches{}; // Bit addr set == break on a write to addr
+	u16 dbgOpValue = 0, dbgOpMask = 0; // Break when (opcode & mask) == value
+	bool dbgOpArmed = false;
+	// Profiling surface; only touched when kProfile (built via CHIP8_PROFILE)
+	std::array<u64, 16> opClassCounts{};
+	std::array<u32, 2048> pcHits{};
+	u64 drwNs{ 0 }, waitKeyNs{ 0 };
 
-	Chip8() {
-		tickStart = SDL_GetTicks();
-		tickTimer = tickStart;
+	Chip8T(bool headlessMode = false) : disp(headlessMode), audio(headlessMode), headless(headlessMode) {
+		clockEpoch = std::chrono::steady_clock::now();
+		seedRng(u64(time(0)) ^ (u64(uintptr_t(this)) << 16));
 		loadFont();
 	}
 
-	void tick() { // The clock cycle of the chip8
-		Uint32 currentTick = SDL_GetTicks();
-		Uint32 tickTime = tickStart - currentTick;
-		updateTimers();
-		if (tickTime < cycleMax)
-			SDL_Delay(cycleMax - tickTime);
-		tickStart = SDL_GetTicks();
+	bool save(FILE* f) { // Checkpoints the whole machine with one fwrite
+		SaveState s{};
+		s.magic = SaveState::MAGIC;
+		s.version = 2; // v2 added the SCHIP framebuffer and mode flag
+		RAM.dump(0, s.ram, sizeof s.ram);
+		memcpy(s.screen, disp.framebuffer().data(), sizeof s.screen);
+		s.stackDepth = sp;
+		memcpy(s.stack, stack.data(), sp * sizeof(u16));
+		memcpy(s.regs, regs.data(), sizeof s.regs);
+		s.i = i;
+		s.pc = pc;
+		s.dt = readDt(); // Snapshot the derived timer values
+		s.st = readSt();
+		s.hires = disp.isHires() ? 1 : 0;
+		s.rngState = rngState;
+		return fwrite(&s, sizeof s, 1, f) == 1;
 	}
 
-	void updateTimers() { // Decrements Timers at a rate of 50 hz if greater than zero
-		Uint32 currentTick = SDL_GetTicks();
-		Uint32 tickTime = currentTick - tickTimer;
-		const Uint32 timerRegRate = 1000 / 50;
-		if (tickTime > timerRegRate) {
-			tickTimer = SDL_GetTicks();
-			if (dt > 0) --dt;
-			if (st > 0) --st;
+	bool restore(FILE* f) {
+		SaveState s;
+		if (fread(&s, sizeof s, 1, f) != 1)
+			return false;
+		if (s.magic != SaveState::MAGIC || s.version != 2)
+			return false;
+		RAM.load(0, s.ram, sizeof s.ram);
+		std::array<u64, 128> screen;
+		memcpy(screen.data(), s.screen, sizeof s.screen);
+		disp.setFramebuffer(screen, s.hires != 0);
+		sp = u8(s.stackDepth < 16 ? s.stackDepth : 16);
+		memcpy(stack.data(), s.stack, sp * sizeof(u16));
+		memcpy(regs.data(), s.regs, sizeof s.regs);
+		i = s.i;
+		pc = s.pc;
+		dtLoad = s.dt; // Timers resume counting down from the restore instant
+		stLoad = s.st;
+		dtTick = stTick = SDL_GetTicks();
+		dtCycles = stCycles = cyclesRun;
+		audio.push(stLoad > 0, u32(stLoad) * timerPeriod); // Resume the beep if ST was live
+		rngState = s.rngState;
+		flushDecodeCache(); // Restored RAM may not match cached decodes
+		return true;
+	}
+
+	void seedRng(u64 seed) { // Zero state would lock xorshift at zero
+		rngState = seed ? seed : 0x9e3779b97f4a7c15ull;
+		rngSeedUsed = rngState;
+	}
+
+	u8 nextRand() { // xorshift64, a handful of inline ALU ops
+		rngState ^= rngState << 13;
+		rngState ^= rngState >> 7;
+		rngState ^= rngState << 17;
+		return u8(rngState >> 32);
+	}
+
+	void syncClock() { // Paces a whole batch of instructions with one sleep
+		using namespace std::chrono;
+		auto target = clockEpoch + nanoseconds(1000000000ull * (cyclesRun - syncBase)
+			/ (u64(clockCycle) * speedMul));
+		auto now = steady_clock::now();
+		if (now < target)
+			std::this_thread::sleep_for(target - now);
+		else if (now - target > milliseconds(100)) // Host stalled; skip the backlog
+			resetGovernor();
+	}
+
+	void resetGovernor() { // Re-anchor pacing after a stall or a speed change
+		clockEpoch = std::chrono::steady_clock::now();
+		syncBase = cyclesRun;
+	}
+
+	void setTurbo(bool on) { // Hold-key fast-forward
+		if (turbo == on)
+			return;
+		turbo = on;
+		disp.setFrameSkip(on ? 4 : 1); // Present every 4th frame while held
+		resetGovernor(); // No catch-up sprint when the key is released
+	}
+
+	void setSpeed(unsigned mul) { // --speed N; 1 == real time
+		speedMul = mul ? mul : 1;
+		resetGovernor();
+	}
+
+	/* The 50 hz timers are lazy: loading one records the value and the load
+	* instant, and the current value is derived on read. No per-instruction
+	* (or per-batch) polling is needed; the clock is only touched when a
+	* timer is loaded or read.
+	*/
+	static const Uint32 timerPeriod = 1000 / 50; // ms per timer decrement
+
+	static u8 timerValue(const u8 & load, const Uint32 & loadTick) {
+		if (load == 0)
+			return 0;
+		Uint32 dec = (SDL_GetTicks() - loadTick) / timerPeriod;
+		return dec >= load ? 0 : load - u8(dec);
+	}
+
+	u8 timerValueEmulated(const u8 & load, const u64 & loadCycles) {
+		// Fast-forward: decrement in emulated time so delays scale with speed
+		if (load == 0)
+			return 0;
+		u64 dec = (cyclesRun - loadCycles) * 50 / clockCycle;
+		return dec >= load ? 0 : load - u8(dec);
+	}
+
+	// Unthrottled runs (bench/batch/test) must not see wall-clock timers, or
+	// any ROM reading DT produces host-speed-dependent results
+	bool fastTime() const { return turbo || speedMul > 1 || !throttle; }
+
+	u8 readDt() {
+		if (replaying)
+			return rpDt;
+		u8 v = fastTime() ? timerValueEmulated(dtLoad, dtCycles) : timerValue(dtLoad, dtTick);
+		if (recording && v != recLastDt) {
+			recLastDt = v;
+			recLog.push_back({ cyclesRun, 1, v, 0 });
+		}
+		return v;
+	}
+
+	u8 readSt() {
+		if (replaying)
+			return rpSt;
+		u8 v = fastTime() ? timerValueEmulated(stLoad, stCycles) : timerValue(stLoad, stTick);
+		if (recording && v != recLastSt) {
+			recLastSt = v;
+			recLog.push_back({ cyclesRun, 2, v, 0 });
 		}
+		return v;
 	}
 
 	void loadFont() { // Loads built in native font into memory
@@ -204,275 +805,1022 @@ struct Chip8 { // Chip 8 Processor: Originally an interpreter for the TELMAC
 			}
 			RAM.WB(fontp++, (n << 4) & 0xf0);
 		}
+		// SCHIP big font (Fx30): the small glyphs with each row doubled,
+		// 10 bytes per digit, directly after the small font at 0x50
+		for (u16 digit = 0; digit < 16; ++digit) {
+			for (u16 row = 0; row < 5; ++row) {
+				u8 bits = RAM.RB(digit * 5 + row);
+				RAM.WB(0x50 + digit * 10 + row * 2, bits);
+				RAM.WB(0x50 + digit * 10 + row * 2 + 1, bits);
+			}
+		}
 	}
 
 	bool keyIsPressed(const u8 & key) {
-		if (io[key]) { return true; }
-		else { return false; }
+		return (keyState >> key) & 1;
 	}
 
-	void checkInput() {
-		for(int i = 0; i < 0xf; i++) { // Reset IO
-			io[i] = false;
+	static int mapKey(SDL_Keycode sym) { // Maps an SDL keycode to a chip8 key, -1 if unmapped
+		switch (sym) {
+		case SDLK_x: return 0x0;
+		case SDLK_1: return 0x1;
+		case SDLK_2: return 0x2;
+		case SDLK_3: return 0x3;
+		case SDLK_q: return 0x4;
+		case SDLK_w: return 0x5;
+		case SDLK_e: return 0x6;
+		case SDLK_a: return 0x7;
+		case SDLK_s: return 0x8;
+		case SDLK_d: return 0x9;
+		case SDLK_z: return 0xa;
+		case SDLK_c: return 0xb;
+		case SDLK_4: return 0xc;
+		case SDLK_r: return 0xd;
+		case SDLK_f: return 0xe;
+		case SDLK_v: return 0xf;
 		}
-		SDL_Event e;
-		while (SDL_PollEvent(&e)) {
-			if (e.type == SDL_QUIT)
+		return -1;
+	}
+
+	int handleEvent(const SDL_Event & e) { // Returns the chip8 key on a fresh keydown
+		if (e.type == SDL_QUIT)
+			running = false;
+		if (e.type == SDL_KEYDOWN) {
+			if (e.key.keysym.sym == SDLK_ESCAPE) {
 				running = false;
-			if (e.type == SDL_KEYDOWN)
-				switch (e.key.keysym.sym) {
-				case SDLK_ESCAPE:
-					running = false;
-					break;
-				case SDLK_x:
-					io[0] = true;
-					break;
-				case SDLK_1:
-					io[1] = true;
-					break;
-				case SDLK_2:
-					io[2] = true;
-					break;
-				case SDLK_3:
-					io[3] = true;
-					break;
-				case SDLK_q:
-					io[4] = true;
-					break;
-				case SDLK_w:
-					io[5] = true;
-					break;
-				case SDLK_e:
-					io[6] = true;
-					break;
-				case SDLK_a:
-					io[7] = true;
-					break;
-				case SDLK_s:
-					io[8] = true;
-					break;
-				case SDLK_d:
-					io[9] = true;
-					break;
-				case SDLK_z:
-					io[0xa] = true;
-					break;
-				case SDLK_c:
-					io[0xb] = true;
-					break;
-				case SDLK_4:
-					io[0xc] = true;
-					break;
-				case SDLK_r:
-					io[0xd] = true;
-					break;
-				case SDLK_f:
-					io[0xe] = true;
-					break;
-				case SDLK_v:
-					io[0xf] = true;
-					break;
-				}
+				return -1;
+			}
+			if (e.key.keysym.sym == SDLK_SPACE) { // Hold for fast-forward
+				setTurbo(true);
+				return -1;
+			}
+			int key = mapKey(e.key.keysym.sym);
+			if (key >= 0) {
+				keyState |= 1u << key;
+				if (recording)
+					recLog.push_back({ cyclesRun, 0, 0, keyState });
+				return key;
+			}
 		}
+		if (e.type == SDL_KEYUP) {
+			if (e.key.keysym.sym == SDLK_SPACE) {
+				setTurbo(false);
+				return -1;
+			}
+			int key = mapKey(e.key.keysym.sym);
+			if (key >= 0) {
+				keyState &= ~(1u << key);
+				if (recording)
+					recLog.push_back({ cyclesRun, 0, 0, keyState });
+			}
+		}
+		return -1;
+	}
 
+	void checkInput() { // Drains the SDL event queue into the latched key bitmask
+		if constexpr (!Input::enabled)
+			return;
+		SDL_Event e;
+		while (SDL_PollEvent(&e)) {
+			handleEvent(e);
+		}
 	}
 
-	u8 getPressedKey() { // Returns first pressed key when one is pressed.
-		printf("getPressedKey()\n");
-		u8 key = 0;
-		while (!io[key]) { // When no key is pressed
-			if (key >= 0xf) {
-				key = 0;
-				checkInput();
+	u8 getPressedKey() { // Parks on the event queue until a mapped key arrives
+		if (replaying) { // Scan the log forward to the next key press
+			while (rpNext < rpLog.size()) {
+				const ReplayEvent & e = rpLog[rpNext++];
+				applyReplayEvent(e);
+				if (e.type == 0 && e.keyBits) {
+					u8 key = 0;
+					while (key < 0xf && !keyIsPressed(key))
+						key++;
+					return key;
+				}
 			}
-			key++;
+			running = false;
+			haltReason = "replay-end";
+			return 0;
+		}
+		if (headless || !Input::enabled) { // No input source; halt instead of spinning forever
+			running = false;
+			haltReason = "wait-key";
+			return 0;
+		}
+		while (running) {
+			SDL_Event e;
+			if (!SDL_WaitEventTimeout(&e, 16))
+				continue;
+			int key = handleEvent(e);
+			if (key >= 0)
+				return u8(key);
 		}
-		printf("%d\n", key);
-		return key;
+		return 0;
 	}
 
 
 
-	void exe(const u16 & opcode) {
-		u8 n0, n1, n2, n3;
-		n0 = (0xF000 & opcode) >> 12; // opcode broken up into nibbles 
-		n1 = (0x0F00 & opcode) >> 8;
-		n2 = (0x00F0 & opcode) >> 4;
-		n3 = (0x000F & opcode);
-		switch (n0) {
-		case 0x0:
-			switch (n3) {
-			case 0x0: // CLS
-				disp.clear();
-				//disp.draw();
-				break;
-			case 0xe: // RET
-				pc = stack.back();
-				stack.pop_back();	
-				break;
-			}
-			break;
-		case 0x1: // JP addr
-			pc = (opcode & 0x0fff);
-			pc -= 2; // counters the inc from main op
-			break;
-		case 0x2: // CALL addr
-			stack.push_back(pc);
-			pc = (opcode & 0x0fff);
-			pc -= 2; // counters the inc from main op
-			break;
-		case 0x3: // SE Vx, byte
-			if (regs[n1] == (opcode & 0x00ff))
-				pc += 2;
-			break;
-		case 0x4: // SNE Vx, byte
-			if (regs[n1] != (opcode & 0x00ff))
-				pc += 2;
-			break;
-		case 0x5: // SE Vx, Vy
-			if (regs[n1] == regs[n2])
-				pc += 2;
-			break;
-		case 0x6: // LD Vx, byte
-			regs[n1] = (opcode & 0x00ff);
-			break;
-		case 0x7: // ADD Vx, byte
-			regs[n1] += (opcode & 0x00ff);
-			break;
-		case 0x8:
-			switch (n3) {
-			case 0x0: // LD Vx, Vy
-				regs[n1] = regs[n2];
-				break;
-			case 0x1: // OR Vx, Vy
-				regs[n1] = regs[n1] | regs[n2];
-				break;
-			case 0x2: // AND Vx, Vy
-				regs[n1] = regs[n1] & regs[n2];
-				break;
-			case 0x3: // XOR Vx, Vy
-				regs[n1] = regs[n1] ^ regs[n2];
-				break;
-			case 0x4: // ADD Vx, Vy
-				regs[n1] += regs[n2];
-				(regs[n1] < regs[n2]) ? regs[0xf] = 1 : regs[0xf] = 0;
-				break;
-			case 0x5: // SUB Vx, Vy
-				(regs[n1] > regs[n2]) ? regs[0xf] = 1 : regs[0xf] = 0;
-				regs[n1] -= regs[n2];
-				break;
-			case 0x6: // SHR Vx {, Vy}
-				(regs[n1] & 0x1) ? regs[0xf] = 1 : regs[0xf] = 0;
-				regs[n1] = regs[n1] >> 1;
-				break;
-			case 0x7: // SUBN Vx, Vy
-				(regs[n2] > regs[n1]) ? regs[0xf] = 1 : regs[0xf] = 0;
-				regs[n1] = regs[n2] - regs[n1];
-				break;
-			case 0xe: // SHL Vx {, Vy}
-				(regs[n1] & 0x80) ? regs[0xf] = 1 : regs[0xf] = 0;
-				regs[n1] = regs[n1] << 1;
-				break;
+	/* Opcode dispatch: a flat table of handler pointers per top nibble, with
+	* flat sub-tables for the 0x0/0x8/0xe/0xf groups, so executing an opcode
+	* is an indexed load and an indirect call instead of nested switches.
+	*/
+	using OpFn = void (Chip8T::*)(const u16 &);
+	static u8 nib1(const u16 & opcode) { return (0x0F00 & opcode) >> 8; }
+	static u8 nib2(const u16 & opcode) { return (0x00F0 & opcode) >> 4; }
+	static u8 nib3(const u16 & opcode) { return (0x000F & opcode); }
+
+	void opNop(const u16 &) {} // Unknown opcode
+
+	void opSys(const u16 & opcode) { (this->*sysOps[opcode & 0xff])(opcode); }
+	void opCls(const u16 &) { // CLS
+		disp.clear();
+	}
+	void opRet(const u16 &) { // RET
+		if (sp == 0) { // RET with no matching CALL
+			printf("Stack underflow at pc=0x%03x\n", pc);
+			running = false;
+			haltReason = "stack-underflow";
+			return;
+		}
+		pc = stack[--sp];
+	}
+	void opScrollDown(const u16 & opcode) { // 00Cn: SCD n
+		disp.scrollDown(opcode & 0xf);
+	}
+	void opScrollRight(const u16 &) { // 00FB: SCR
+		disp.scrollRight();
+	}
+	void opScrollLeft(const u16 &) { // 00FC: SCL
+		disp.scrollLeft();
+	}
+	void opExit(const u16 &) { // 00FD: EXIT
+		running = false;
+		haltReason = "exit-opcode";
+	}
+	void opLores(const u16 &) { // 00FE: LOW
+		disp.setHires(false);
+	}
+	void opHires(const u16 &) { // 00FF: HIGH
+		disp.setHires(true);
+	}
+	/* Idle-loop detection: a 1nnn jump to its own address, or a short
+	* backward loop whose only side effects are reading DT and comparing,
+	* is a busy-wait. Instead of executing it at clockCycle speed we sleep
+	* to the next timer edge (or input poll) and re-anchor the governor, so
+	* a parked menu screen costs ~0 host CPU with no behavioral change.
+	*/
+	bool isTimerPollLoop(const u16 & target) { // Body may only read DT and branch
+		bool readsDt = false;
+		for (u16 a = target; a < pc; a += 2) {
+			u16 op = RAM.RW(a);
+			if ((op & 0xf0ff) == 0xf007) { // LD Vx, DT
+				readsDt = true;
+				continue;
 			}
-			break;
-		case 0x9: // SNE Vx, Vy
-			if (regs[n1] != regs[n2])
-				pc += 2;
-			break;
-		case 0xa: // LD I, addr
-			i = (opcode & 0x0fff);
-			break;
-		case 0xb: // JP V0, addr
+			u8 top = op >> 12;
+			if (top == 0x3 || top == 0x4 || top == 0x5 || top == 0x9) // SE/SNE
+				continue;
+			return false;
+		}
+		return readsDt;
+	}
+
+	void idleWait() {
+		if (replaying || !throttle)
+			return; // Replay feeds events by cycle; bench measures raw dispatch
+		if (fastTime()) { // Timers count emulated cycles; hop to the next 50 hz edge
+			if (!recording) // The replay clock counts executed instructions only
+				cyclesRun += clockCycle / 50;
+			return;
+		}
+		Uint32 ms = 16; // Wake at least once per input-poll period
+		if (dtLoad) { // Sooner if the next DT decrement is due first
+			Uint32 next = timerPeriod - (SDL_GetTicks() - dtTick) % timerPeriod;
+			if (next < ms)
+				ms = next ? next : 1;
+		}
+		std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+		cyclesToPoll = 0; // Poll input promptly on wake
+		resetGovernor(); // The slept time is not a backlog to catch up
+	}
+
+	void opJp(const u16 & opcode) { // JP addr
+		u16 target = opcode & 0x0fff;
+		if (target == pc // Jump-to-self: the ROM is parked for good or for a timer
+			|| (target < pc && pc - target <= 8 && isTimerPollLoop(target)))
+			idleWait();
+		pc = target;
+		pc -= 2; // counters the inc from main op
+	}
+	void opCall(const u16 & opcode) { // CALL addr
+		if (sp >= stack.size()) { // 17th nesting level; no real program does this
+			printf("Stack overflow at pc=0x%03x\n", pc);
+			running = false;
+			haltReason = "stack-overflow";
+			return;
+		}
+		stack[sp++] = pc;
+		pc = (opcode & 0x0fff);
+		pc -= 2; // counters the inc from main op
+	}
+	void opSeImm(const u16 & opcode) { // SE Vx, byte
+		if (regs[nib1(opcode)] == (opcode & 0x00ff))
+			pc += 2;
+	}
+	void opSneImm(const u16 & opcode) { // SNE Vx, byte
+		if (regs[nib1(opcode)] != (opcode & 0x00ff))
+			pc += 2;
+	}
+	void opSeReg(const u16 & opcode) { // SE Vx, Vy
+		if (regs[nib1(opcode)] == regs[nib2(opcode)])
+			pc += 2;
+	}
+	void opLdImm(const u16 & opcode) { // LD Vx, byte
+		regs[nib1(opcode)] = (opcode & 0x00ff);
+	}
+	void opAddImm(const u16 & opcode) { // ADD Vx, byte
+		regs[nib1(opcode)] += (opcode & 0x00ff);
+	}
+	void opAlu(const u16 & opcode) { (this->*aluOps[opcode & 0xf])(opcode); }
+	void opAluLd(const u16 & opcode) { // LD Vx, Vy
+		regs[nib1(opcode)] = regs[nib2(opcode)];
+	}
+	void opAluOr(const u16 & opcode) { // OR Vx, Vy
+		regs[nib1(opcode)] = regs[nib1(opcode)] | regs[nib2(opcode)];
+	}
+	void opAluAnd(const u16 & opcode) { // AND Vx, Vy
+		regs[nib1(opcode)] = regs[nib1(opcode)] & regs[nib2(opcode)];
+	}
+	void opAluXor(const u16 & opcode) { // XOR Vx, Vy
+		regs[nib1(opcode)] = regs[nib1(opcode)] ^ regs[nib2(opcode)];
+	}
+	void opAluAdd(const u16 & opcode) { // ADD Vx, Vy
+		u8 n1 = nib1(opcode), n2 = nib2(opcode);
+		regs[n1] += regs[n2];
+		(regs[n1] < regs[n2]) ? regs[0xf] = 1 : regs[0xf] = 0;
+	}
+	void opAluSub(const u16 & opcode) { // SUB Vx, Vy
+		u8 n1 = nib1(opcode), n2 = nib2(opcode);
+		(regs[n1] > regs[n2]) ? regs[0xf] = 1 : regs[0xf] = 0;
+		regs[n1] -= regs[n2];
+	}
+	void opAluShr(const u16 & opcode) { // SHR Vx {, Vy}
+		u8 n1 = nib1(opcode);
+		if constexpr (Quirks::shiftUsesVy)
+			regs[n1] = regs[nib2(opcode)];
+		(regs[n1] & 0x1) ? regs[0xf] = 1 : regs[0xf] = 0;
+		regs[n1] = regs[n1] >> 1;
+	}
+	void opAluSubn(const u16 & opcode) { // SUBN Vx, Vy
+		u8 n1 = nib1(opcode), n2 = nib2(opcode);
+		(regs[n2] > regs[n1]) ? regs[0xf] = 1 : regs[0xf] = 0;
+		regs[n1] = regs[n2] - regs[n1];
+	}
+	void opAluShl(const u16 & opcode) { // SHL Vx {, Vy}
+		u8 n1 = nib1(opcode);
+		if constexpr (Quirks::shiftUsesVy)
+			regs[n1] = regs[nib2(opcode)];
+		(regs[n1] & 0x80) ? regs[0xf] = 1 : regs[0xf] = 0;
+		regs[n1] = regs[n1] << 1;
+	}
+	void opSneReg(const u16 & opcode) { // SNE Vx, Vy
+		if (regs[nib1(opcode)] != regs[nib2(opcode)])
+			pc += 2;
+	}
+	void opLdI(const u16 & opcode) { // LD I, addr
+		i = (opcode & 0x0fff);
+	}
+	void opJpV0(const u16 & opcode) { // JP V0, addr (Bxnn uses Vx under SCHIP)
+		if constexpr (Quirks::jumpUsesVx)
+			pc = regs[nib1(opcode)] + (opcode & 0x0fff);
+		else
 			pc = regs[0x0] + (opcode & 0x0fff);
-			pc -= 2; // counters the inc from main op
-			break;
-		case 0xc: // RND Vx, byte
-			regs[n1] = (rand() % 256) & (opcode & 0x00ff);
-			break;
-		case 0xd: // DRW Vx, Vy, nibble
-			if (!disp.predrawSurf(i, RAM, n3, regs[n1], regs[n2]))
-				regs[0xf] = 1;
-			else
-				regs[0xf] = 0;
-			disp.draw();
-			break;
-		case 0xe:
-			switch (n2) {
-			case 0x9:
-				if (keyIsPressed(regs[n1]))
-					pc += 2;
-				break;
-			case 0xa:
-				if (!keyIsPressed(regs[n1]))
-					pc += 2;
-				break;
-			}
-			break;
-		case 0xf:
-			switch ((n2 << 4) | n3) {
-			case 0x07: // LD Vx, DT
-				regs[n1] = dt;
-				break;
-			case 0x0a: // LD Vx, K
-				regs[n1] = getPressedKey();
-				break;
-			case 0x15: // LD DT, Vx
-				dt = regs[n1];
-				break;
-			case 0x18: // LD ST, Vx
-				st = regs[n1];
-				break;
-			case 0x1e: // AND I, Vx
-				i = i + regs[n1];
-				break;
-			case 0x29: // LD F, Vx
-				i = regs[n1] * 5;
-				break;
-			case 0x33: // LD B, Vx
-				RAM.WB(i, (regs[n1] / 100) % 10);
-				RAM.WB(i + 1, (regs[n1] / 10) % 10);
-				RAM.WB(i + 2, regs[n1] % 10);
-				break;
-			case 0x55: // LD [I], Vx
-				for (int j = 0; j < n1; ++j) {
-					RAM.WB(i + j, regs[j]);
-				}
-				break;
-			case 0x65: // LD Vx, [I]
-				for (int j = 0; j < n1; ++j) {
-					regs[j] = RAM.RB(i + j);
-				}
+		pc -= 2; // counters the inc from main op
+	}
+	void opRnd(const u16 & opcode) { // RND Vx, byte
+		regs[nib1(opcode)] = nextRand() & (opcode & 0x00ff);
+	}
+	void opDrw(const u16 & opcode) { // DRW Vx, Vy, nibble
+		ProfTimer profile(drwNs);
+		u8 nBytes = nib3(opcode); // Dxy0 reads a 16x16 sprite: 32 bytes
+		regs[0xf] = disp.predrawSurf(RAM.window(i, nBytes ? nBytes : 32), nBytes, regs[nib1(opcode)], regs[nib2(opcode)]) ? 1 : 0;
+		// Presenting happens on the display's presenter thread
+	}
+	void opKey(const u16 & opcode) { (this->*keyOps[(opcode >> 4) & 0xf])(opcode); }
+	void opSkp(const u16 & opcode) { // SKP Vx
+		if (keyIsPressed(regs[nib1(opcode)]))
+			pc += 2;
+	}
+	void opSknp(const u16 & opcode) { // SKNP Vx
+		if (!keyIsPressed(regs[nib1(opcode)]))
+			pc += 2;
+	}
+	void opMisc(const u16 & opcode) { (this->*miscOps[opcode & 0xff])(opcode); }
+	void opLdVxDt(const u16 & opcode) { // LD Vx, DT
+		regs[nib1(opcode)] = readDt();
+	}
+	void opLdVxK(const u16 & opcode) { // LD Vx, K
+		ProfTimer profile(waitKeyNs);
+		regs[nib1(opcode)] = getPressedKey();
+	}
+	void opLdDt(const u16 & opcode) { // LD DT, Vx
+		dtLoad = regs[nib1(opcode)];
+		dtTick = SDL_GetTicks();
+		dtCycles = cyclesRun;
+	}
+	void opLdSt(const u16 & opcode) { // LD ST, Vx
+		stLoad = regs[nib1(opcode)];
+		stTick = SDL_GetTicks();
+		stCycles = cyclesRun;
+		audio.push(stLoad > 0, u32(stLoad) * timerPeriod); // Beep for the timer's lifetime
+	}
+	void opAddI(const u16 & opcode) { // ADD I, Vx
+		i = i + regs[nib1(opcode)];
+	}
+	void opLdF(const u16 & opcode) { // LD F, Vx
+		i = regs[nib1(opcode)] * 5;
+	}
+	void opLdHF(const u16 & opcode) { // LD HF, Vx: SCHIP big font digit
+		i = 0x50 + regs[nib1(opcode)] * 10;
+	}
+	void opLdB(const u16 & opcode) { // LD B, Vx
+		u8 n1 = nib1(opcode);
+		writeRAM(i, (regs[n1] / 100) % 10);
+		writeRAM(i + 1, (regs[n1] / 10) % 10);
+		writeRAM(i + 2, regs[n1] % 10);
+	}
+	void opLdIVx(const u16 & opcode) { // LD [I], Vx
+		unsigned count = nib1(opcode) + 1; // V0 through Vx inclusive
+		if (dbgActive) { // Byte-wise so watchpoints see the bulk store too
+			for (unsigned j = 0; j < count; ++j)
+				writeRAM(i + j, regs[j]);
+		}
+		else {
+			RAM.load(i, regs.data(), count);
+			icache[((i - 1) >> 1) & 2047].fn = nullptr; // Keep the decode cache honest
+			for (unsigned j = 0; j < count; ++j) {
+				icache[((i + j) >> 1) & 2047].fn = nullptr;
 			}
 		}
+		if constexpr (Quirks::loadStoreIncrementsI)
+			i = i + count;
+	}
+	void opLdVxI(const u16 & opcode) { // LD Vx, [I]
+		unsigned count = nib1(opcode) + 1; // V0 through Vx inclusive
+		RAM.dump(i, regs.data(), count);
+		if constexpr (Quirks::loadStoreIncrementsI)
+			i = i + count;
+	}
+
+	static std::array<OpFn, 16> makeMainOps() {
+		std::array<OpFn, 16> t;
+		t.fill(&Chip8T::opNop);
+		t[0x0] = &Chip8T::opSys;
+		t[0x1] = &Chip8T::opJp;
+		t[0x2] = &Chip8T::opCall;
+		t[0x3] = &Chip8T::opSeImm;
+		t[0x4] = &Chip8T::opSneImm;
+		t[0x5] = &Chip8T::opSeReg;
+		t[0x6] = &Chip8T::opLdImm;
+		t[0x7] = &Chip8T::opAddImm;
+		t[0x8] = &Chip8T::opAlu;
+		t[0x9] = &Chip8T::opSneReg;
+		t[0xa] = &Chip8T::opLdI;
+		t[0xb] = &Chip8T::opJpV0;
+		t[0xc] = &Chip8T::opRnd;
+		t[0xd] = &Chip8T::opDrw;
+		t[0xe] = &Chip8T::opKey;
+		t[0xf] = &Chip8T::opMisc;
+		return t;
+	}
+	static std::array<OpFn, 256> makeSysOps() { // 0x0 group keyed on low byte
+		std::array<OpFn, 256> t;
+		t.fill(&Chip8T::opNop);
+		t[0xe0] = &Chip8T::opCls;
+		t[0xee] = &Chip8T::opRet;
+		for (int n = 0; n < 16; ++n) // 00Cn scroll-down family
+			t[0xc0 + n] = &Chip8T::opScrollDown;
+		t[0xfb] = &Chip8T::opScrollRight;
+		t[0xfc] = &Chip8T::opScrollLeft;
+		t[0xfd] = &Chip8T::opExit;
+		t[0xfe] = &Chip8T::opLores;
+		t[0xff] = &Chip8T::opHires;
+		return t;
+	}
+	static std::array<OpFn, 16> makeAluOps() { // 0x8 group keyed on low nibble
+		std::array<OpFn, 16> t;
+		t.fill(&Chip8T::opNop);
+		t[0x0] = &Chip8T::opAluLd;
+		t[0x1] = &Chip8T::opAluOr;
+		t[0x2] = &Chip8T::opAluAnd;
+		t[0x3] = &Chip8T::opAluXor;
+		t[0x4] = &Chip8T::opAluAdd;
+		t[0x5] = &Chip8T::opAluSub;
+		t[0x6] = &Chip8T::opAluShr;
+		t[0x7] = &Chip8T::opAluSubn;
+		t[0xe] = &Chip8T::opAluShl;
+		return t;
+	}
+	static std::array<OpFn, 16> makeKeyOps() { // 0xe group keyed on third nibble
+		std::array<OpFn, 16> t;
+		t.fill(&Chip8T::opNop);
+		t[0x9] = &Chip8T::opSkp;
+		t[0xa] = &Chip8T::opSknp;
+		return t;
+	}
+	static std::array<OpFn, 256> makeMiscOps() { // 0xf group keyed on low byte
+		std::array<OpFn, 256> t;
+		t.fill(&Chip8T::opNop);
+		t[0x07] = &Chip8T::opLdVxDt;
+		t[0x0a] = &Chip8T::opLdVxK;
+		t[0x15] = &Chip8T::opLdDt;
+		t[0x18] = &Chip8T::opLdSt;
+		t[0x1e] = &Chip8T::opAddI;
+		t[0x29] = &Chip8T::opLdF;
+		t[0x30] = &Chip8T::opLdHF;
+		t[0x33] = &Chip8T::opLdB;
+		t[0x55] = &Chip8T::opLdIVx;
+		t[0x65] = &Chip8T::opLdVxI;
+		return t;
+	}
+	static inline const std::array<OpFn, 16> mainOps = makeMainOps();
+	static inline const std::array<OpFn, 256> sysOps = makeSysOps();
+	static inline const std::array<OpFn, 16> aluOps = makeAluOps();
+	static inline const std::array<OpFn, 16> keyOps = makeKeyOps();
+	static inline const std::array<OpFn, 256> miscOps = makeMiscOps();
+
+	void exe(const u16 & opcode) {
+		(this->*mainOps[opcode >> 12])(opcode);
+	}
+
+	/* Decoded-instruction cache: each program location is decoded once into a
+	* leaf handler pointer (group sub-tables resolved up front) plus the raw
+	* opcode, so the steady-state path is one array load and one indirect
+	* call. Entries are invalidated when RAM under them is written.
+	*/
+	struct Decoded {
+		OpFn fn{ nullptr }; // null == not yet decoded
+		u16 opcode{ 0 };
+		u16 pc{ 0 }; // Tag, in case two addresses share a slot
+	};
+	std::array<Decoded, 2048> icache{};
+
+	static OpFn decodeLeaf(const u16 & opcode) { // Resolve group indirections once
+		switch (opcode >> 12) {
+		case 0x0: return sysOps[opcode & 0xff];
+		case 0x8: return aluOps[opcode & 0xf];
+		case 0xe: return keyOps[(opcode >> 4) & 0xf];
+		case 0xf: return miscOps[opcode & 0xff];
+		}
+		return mainOps[opcode >> 12];
+	}
+
+	void writeRAM(const u16 & addr, const u8 & value) { // WB plus icache invalidation
+		if (dbgActive && ((memWatches[(addr & 0xfff) >> 6] >> (addr & 63)) & 1)) {
+			printf("watchpoint 0x%03x: %u -> %u at pc=0x%03x cycle=%llu\n",
+				addr & 0xfff, RAM.RB(addr), value, pc, cyclesRun);
+			running = false;
+			haltReason = "watchpoint";
+		}
+		RAM.WB(addr, value);
+		icache[(addr >> 1) & 2047].fn = nullptr; // Opcode starting at addr
+		icache[((addr - 1) >> 1) & 2047].fn = nullptr; // Opcode spanning addr-1..addr
+	}
+
+	void setBreakpoint(u16 addr) {
+		pcBreaks[(addr & 0xfff) >> 6] |= 1ull << (addr & 63);
+		dbgActive = true;
+	}
+	void clearBreakpoint(u16 addr) {
+		pcBreaks[(addr & 0xfff) >> 6] &= ~(1ull << (addr & 63));
+		rearmDebug();
+	}
+	void setWatchpoint(u16 addr) {
+		memWatches[(addr & 0xfff) >> 6] |= 1ull << (addr & 63);
+		dbgActive = true;
+	}
+	void clearWatchpoint(u16 addr) {
+		memWatches[(addr & 0xfff) >> 6] &= ~(1ull << (addr & 63));
+		rearmDebug();
+	}
+	void setOpcodeBreak(u16 value, u16 mask) { // mask 0 disarms the pattern
+		dbgOpValue = value & mask;
+		dbgOpMask = mask;
+		dbgOpArmed = mask != 0;
+		rearmDebug();
+	}
+	void rearmDebug() { // Recompute the one flag the hot path looks at
+		dbgActive = dbgOpArmed;
+		for (unsigned w = 0; w < 64; ++w)
+			if (pcBreaks[w] | memWatches[w])
+				dbgActive = true;
+	}
+
+	bool debugCheck(const u16 & opcode) { // Only reached while dbgActive; true == halted
+		if ((pcBreaks[(pc & 0xfff) >> 6] >> (pc & 63)) & 1)
+			return debugHit("breakpoint", opcode);
+		if (dbgOpArmed && (opcode & dbgOpMask) == dbgOpValue)
+			return debugHit("opcode-break", opcode);
+		return false;
+	}
+	bool debugHit(const char* what, const u16 & opcode) {
+		printf("%s at pc=0x%03x opcode=0x%04x cycle=%llu\n", what, pc, opcode, cyclesRun);
+		running = false;
+		haltReason = what;
+		return true;
+	}
+
+	void flushDecodeCache() { // After bulk RAM loads (ROM load, savestate restore)
+		for (auto & d : icache)
+			d.fn = nullptr;
+	}
+
+	void dumpProfile() { // Sorted execution report; no-op in non-profiled builds
+		if constexpr (kProfile) {
+			static const char* classNames[16] = {
+				"sys", "jp", "call", "se", "sne", "sevv", "ldvx", "addvx",
+				"alu", "snevv", "ldi", "jpv0", "rnd", "drw", "key", "misc" };
+			std::array<int, 16> order;
+			for (int n = 0; n < 16; ++n)
+				order[n] = n;
+			std::sort(order.begin(), order.end(),
+				[&](int a, int b) { return opClassCounts[a] > opClassCounts[b]; });
+			printf("opcode class counts:\n");
+			for (int n : order)
+				if (opClassCounts[n])
+					printf("  %-6s %llu\n", classNames[n], (unsigned long long)opClassCounts[n]);
+			std::array<int, 2048> pcOrder;
+			for (int n = 0; n < 2048; ++n)
+				pcOrder[n] = n;
+			std::partial_sort(pcOrder.begin(), pcOrder.begin() + 8, pcOrder.end(),
+				[&](int a, int b) { return pcHits[a] > pcHits[b]; });
+			printf("hottest pcs:\n");
+			for (int n = 0; n < 8; ++n)
+				if (pcHits[pcOrder[n]])
+					printf("  0x%03x %u\n", 0x200 + pcOrder[n] * 2, pcHits[pcOrder[n]]);
+			printf("host time: drw %.3f ms, wait-key %.3f ms\n", drwNs / 1e6, waitKeyNs / 1e6);
+		}
+	}
+
+	void applyReplayEvent(const ReplayEvent & e) {
+		if (e.type == 0)
+			keyState = e.keyBits;
+		else if (e.type == 1)
+			rpDt = e.value;
+		else
+			rpSt = e.value;
+	}
+
+	bool saveReplay(const char* path) { // Header + the whole log in one write
+		FILE* f = fopen(path, "wb");
+		if (f == NULL)
+			return false;
+		u64 header[3] = { 0x43385250, 1, rngSeedUsed }; // "C8RP", version, seed
+		bool ok = fwrite(header, sizeof header, 1, f) == 1;
+		if (ok && !recLog.empty())
+			ok = fwrite(recLog.data(), sizeof(ReplayEvent), recLog.size(), f) == recLog.size();
+		fclose(f);
+		return ok;
+	}
+
+	bool loadReplay(const char* path) {
+		FILE* f = fopen(path, "rb");
+		if (f == NULL)
+			return false;
+		u64 header[3];
+		if (fread(header, sizeof header, 1, f) != 1 || header[0] != 0x43385250 || header[1] != 1) {
+			fclose(f);
+			return false;
+		}
+		seedRng(header[2]);
+		ReplayEvent e;
+		while (fread(&e, sizeof e, 1, f) == 1)
+			rpLog.push_back(e);
+		fclose(f);
+		rpNext = 0;
+		replaying = true;
+		throttle = false; // Replays run flat out
+		return true;
 	}
 
 	void op() {
-		u16 opcode = (RAM.RB(pc) << 8) | RAM.RB(pc + 1);
-		checkInput();
-		exe(opcode);
+		if (replaying) { // Feed back logged events at their recorded cycles
+			while (rpNext < rpLog.size() && rpLog[rpNext].cycles <= cyclesRun)
+				applyReplayEvent(rpLog[rpNext++]);
+		}
+		else if (Input::enabled && !headless && cyclesToPoll == 0) { // Only poll SDL events every pollInterval cycles
+			checkInput();
+			cyclesToPoll = pollInterval;
+		}
+		--cyclesToPoll;
+		Decoded & d = icache[(pc >> 1) & 2047];
+		if (d.fn == nullptr || d.pc != pc) { // Decode once, reuse on every later visit
+			d.opcode = RAM.RW(pc);
+			d.fn = decodeLeaf(d.opcode);
+			d.pc = pc;
+		}
+		if (dbgActive && debugCheck(d.opcode)) // One predictable branch when disarmed
+			return;
+		if (trace.active()) { // Struct copy into the ring; formatting happens offline
+			TraceRec r{ pc, d.opcode, {} };
+			memcpy(r.regs, regs.data(), sizeof r.regs);
+			trace.push(r);
+		}
+		if constexpr (kProfile) {
+			++opClassCounts[d.opcode >> 12];
+			++pcHits[((pc - 0x200) >> 1) & 2047];
+		}
+		(this->*d.fn)(d.opcode);
 		pc += 2; // Each instruction is 2 bytes long
-		tick();
+		++cyclesRun;
+		if (--cyclesToSync == 0) { // Pacing once per batch
+			cyclesToSync = batchSize;
+			if (throttle && !turbo)
+				syncClock();
+		}
 	}
 };
 
 
-int main(int /*argc*/, char ** argv) {
-	srand(time(0));
-	Chip8 sys;
-	FILE* f = fopen(argv[1], "rb");
-	if (f == NULL) perror("File could not be opened");
-	else {
-		signed n = fgetc(f);
-		unsigned memAddr = 0x200;
-		while (n != EOF) {
-			sys.RAM.WB(memAddr++, u8(n & 0xff));
-			n = fgetc(f);
+/* Build-time core selection: the compute-only build (-DCHIP8_NULLIO) swaps
+* the null display/input policies in for every quirk profile, so one source
+* produces the interactive, headless-fast, and profiling binaries.
+*/
+#ifdef CHIP8_NULLIO
+template<typename Quirks> using CoreFor = Chip8T<Quirks, NullDisplay, NullInput>;
+#else
+template<typename Quirks> using CoreFor = Chip8T<Quirks>;
+#endif
+using Chip8 = CoreFor<QuirksSchip>; // Default core; SCHIP quirk profile
+
+template<typename Core>
+bool loadRom(Core & sys, const char* path) { // Reads the whole ROM with one I/O call
+	FILE* f = fopen(path, "rb");
+	if (f == NULL) {
+		perror("File could not be opened");
+		return false;
+	}
+	std::array<u8, 4096 - 0x200> buf;
+	size_t len = fread(buf.data(), 1, buf.size(), f);
+	fclose(f);
+	sys.RAM.load(0x200, buf.data(), len);
+	sys.flushDecodeCache();
+	return true;
+}
+
+template<typename Core>
+void runBench(Core & sys, unsigned long long nInstr, const char* label) {
+	sys.throttle = false;
+	auto start = std::chrono::steady_clock::now();
+	unsigned long long n = 0;
+	for (; n < nInstr && sys.running; ++n) {
+		sys.op();
+	}
+	double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	printf("%s: %llu instructions in %.3f s (%.2f MIPS)\n", label, n, secs, n / secs / 1e6);
+}
+
+template<typename Core>
+void loadOpcodes(Core & sys, const u16* ops, unsigned count) {
+	u16 addr = 0x200;
+	for (unsigned n = 0; n < count; ++n) {
+		sys.RAM.WB(addr++, ops[n] >> 8);
+		sys.RAM.WB(addr++, ops[n] & 0xff);
+	}
+	sys.flushDecodeCache();
+}
+
+void runMicrobench(unsigned long long nInstr) { // Tiny loops exercising one opcode class each
+	const u16 aluRom[] = { 0x6005, 0x6103, 0x8014, 0x8011, 0x8012, 0x8013, 0x8015, 0x1204 };
+	const u16 flowRom[] = { 0x6001, 0x3005, 0x9010, 0x0000, 0x1200 };
+	const u16 drawRom[] = { 0x6000, 0x6100, 0xa000, 0xd015, 0x1204 };
+	struct { const char* name; const u16* ops; unsigned count; } classes[] = {
+		{ "alu", aluRom, 8 },
+		{ "flow", flowRom, 5 },
+		{ "draw", drawRom, 5 },
+	};
+	for (auto & c : classes) {
+		Chip8 sys(true); // Fresh headless core per class
+		loadOpcodes(sys, c.ops, c.count);
+		runBench(sys, nInstr, c.name);
+	}
+}
+
+void runBatch(const char* dir, unsigned jobs, unsigned long long cycleBudget) {
+	std::vector<std::string> roms;
+	DIR* d = opendir(dir);
+	if (d == NULL) {
+		perror("Batch directory could not be opened");
+		return;
+	}
+	while (struct dirent* entry = readdir(d)) {
+		if (entry->d_name[0] == '.')
+			continue;
+		roms.push_back(std::string(dir) + "/" + entry->d_name);
+	}
+	closedir(d);
+
+	std::atomic<size_t> nextRom{ 0 };
+	std::mutex reportLock;
+	auto worker = [&]() { // One display-less core per ROM, no shared mutable state
+		size_t idx;
+		while ((idx = nextRom.fetch_add(1)) < roms.size()) {
+			Chip8 sys(true);
+			sys.throttle = false;
+			unsigned long long cycles = 0;
+			const char* reason = "load-failed";
+			if (loadRom(sys, roms[idx].c_str())) {
+				for (; cycles < cycleBudget && sys.running; ++cycles)
+					sys.op();
+				reason = sys.running ? "budget" : (sys.haltReason ? sys.haltReason : "halted");
+			}
+			std::lock_guard<std::mutex> lock(reportLock);
+			printf("%s: %llu cycles (%s)\n", roms[idx].c_str(), cycles, reason);
 		}
+	};
+	std::vector<std::thread> pool;
+	for (unsigned n = 0; n < jobs; ++n)
+		pool.emplace_back(worker);
+	for (auto & t : pool)
+		t.join();
+}
+
+u64 fnv1a(const u8* p, size_t len) { // FNV-1a; cheap, stable, good enough for keys and asserts
+	u64 h = 0xcbf29ce484222325ull;
+	for (size_t n = 0; n < len; ++n) {
+		h ^= p[n];
+		h *= 0x100000001b3ull;
+	}
+	return h;
+}
+
+struct RomMeta { // Sidecar record: static ROM analysis cached between launches
+	static const u32 MAGIC = 0x43384d44; // "C8MD"
+	u32 magic;
+	u32 version;
+	u64 romHash; // FNV-1a of the ROM bytes; stale sidecars are ignored
+	u32 romSize;
+	u32 clockCycle; // Recommended interpreter rate, Hz
+	u8 schip; // 1 == ROM uses SCHIP-only opcodes
+	u8 pad[1];
+	u16 entryOpcode; // First opcode at 0x200
+	u32 drawOps; // DRW count from the static scan
+};
+
+RomMeta analyzeRom(const u8* rom, size_t len) { // One-time static scan
+	RomMeta m{};
+	m.magic = RomMeta::MAGIC;
+	m.version = 1;
+	m.romHash = fnv1a(rom, len);
+	m.romSize = u32(len);
+	m.entryOpcode = len >= 2 ? u16((rom[0] << 8) | rom[1]) : 0;
+	for (size_t n = 0; n + 1 < len; n += 2) {
+		u16 op = u16((rom[n] << 8) | rom[n + 1]);
+		if (op == 0x00fe || op == 0x00ff || op == 0x00fb || op == 0x00fc
+			|| (op & 0xfff0) == 0x00c0 || (op & 0xf0ff) == 0xf030
+			|| (op & 0xf00f) == 0xd000) // Dxy0: 16x16 sprite
+			m.schip = 1;
+		if (op >> 12 == 0xd)
+			++m.drawOps;
+	}
+	// Starting points, not gospel: SCHIP titles expect a faster interpreter
+	m.clockCycle = m.schip ? 10000 : 5000;
+	return m;
+}
 
-		while (sys.running) {
+bool loadRomMeta(const char* sidecar, const u8* rom, size_t len, RomMeta & m) {
+	FILE* f = fopen(sidecar, "rb");
+	if (f == NULL)
+		return false;
+	size_t got = fread(&m, sizeof m, 1, f);
+	fclose(f);
+	return got == 1 && m.magic == RomMeta::MAGIC && m.version == 1
+		&& m.romSize == len && m.romHash == fnv1a(rom, len);
+}
+
+/* First launch of a ROM runs the static scan and writes the sidecar; later
+* launches get the cached record back after only hashing the file.
+*/
+RomMeta romMetadata(const char* romPath) {
+	std::array<u8, 4096 - 0x200> buf;
+	FILE* f = fopen(romPath, "rb");
+	if (f == NULL)
+		return RomMeta{}; // loadRom will report the open failure
+	size_t len = fread(buf.data(), 1, buf.size(), f);
+	fclose(f);
+	std::string sidecar = std::string(romPath) + ".c8meta";
+	RomMeta m;
+	if (loadRomMeta(sidecar.c_str(), buf.data(), len, m))
+		return m;
+	m = analyzeRom(buf.data(), len);
+	if (FILE* out = fopen(sidecar.c_str(), "wb")) {
+		fwrite(&m, sizeof m, 1, out);
+		fclose(out);
+	}
+	return m;
+}
+
+/* Test runner: each manifest line is "rom cycle-budget expected-hash", the
+* hash being FNV-1a over the raw framebuffer words after the run. A '?'
+* hash prints the computed value instead of judging it, for authoring new
+* cases. Runs headless and unthrottled on the batch worker-pool pattern.
+*/
+int runTests(const char* manifestPath, unsigned jobs) {
+	struct Case { std::string rom; unsigned long long budget; u64 want; bool judged; };
+	std::vector<Case> cases;
+	FILE* f = fopen(manifestPath, "r");
+	if (f == NULL) {
+		perror("Manifest could not be opened");
+		return 1;
+	}
+	char line[640];
+	while (fgets(line, sizeof line, f)) {
+		char rom[512], hash[32];
+		unsigned long long budget;
+		if (line[0] == '#' || sscanf(line, "%511s %llu %31s", rom, &budget, hash) != 3)
+			continue;
+		cases.push_back({ rom, budget, strtoull(hash, 0, 16), hash[0] != '?' });
+	}
+	fclose(f);
+
+	std::atomic<size_t> nextCase{ 0 };
+	std::atomic<unsigned> failures{ 0 };
+	std::mutex reportLock;
+	auto worker = [&]() {
+		size_t idx;
+		while ((idx = nextCase.fetch_add(1)) < cases.size()) {
+			Case & c = cases[idx];
+			Chip8 sys(true);
+			sys.throttle = false;
+			unsigned long long cycles = 0;
+			auto start = std::chrono::steady_clock::now();
+			bool loaded = loadRom(sys, c.rom.c_str());
+			if (loaded)
+				for (; cycles < c.budget && sys.running; ++cycles)
+					sys.op();
+			double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			const auto & fb = sys.disp.framebuffer();
+			u64 got = fnv1a((const u8*)fb.data(), fb.size() * sizeof(u64));
+			std::lock_guard<std::mutex> lock(reportLock);
+			if (!loaded) {
+				printf("FAIL %s: load failed\n", c.rom.c_str());
+				++failures;
+			}
+			else if (!c.judged)
+				printf("HASH %s: %016llx after %llu cycles\n", c.rom.c_str(),
+					(unsigned long long)got, cycles);
+			else if (got == c.want)
+				printf("PASS %s: %llu cycles (%.2f Mcycles/s)\n", c.rom.c_str(),
+					cycles, cycles / secs / 1e6);
+			else {
+				printf("FAIL %s: hash %016llx, want %016llx\n", c.rom.c_str(),
+					(unsigned long long)got, (unsigned long long)c.want);
+				++failures;
+			}
+		}
+	};
+	std::vector<std::thread> pool;
+	for (unsigned n = 0; n < jobs; ++n)
+		pool.emplace_back(worker);
+	for (auto & t : pool)
+		t.join();
+	unsigned bad = failures.load();
+	printf("%zu cases, %u failed\n", cases.size(), bad);
+	return bad ? 1 : 0;
+}
+
+struct RunOpts { // Settings shared by the per-profile run paths
+	bool headless = false;
+	u64 rngSeed = 0;
+	unsigned long long benchMillions = 0;
+	const char* recordPath = nullptr;
+	const char* replayPath = nullptr;
+	unsigned speedMul = 1;
+	const char* tracePath = nullptr;
+	int breakAddr = -1; // PC breakpoint, -1 == none
+	int watchAddr = -1; // Memory write watchpoint, -1 == none
+	long breakOp = -1; // Opcode pattern (value in the low 16 bits), -1 == none
+	u16 breakOpMask = 0xffff;
+	unsigned clockCycle = 0; // From the metadata cache; 0 == keep the default
+};
+
+template<typename Quirks>
+int runRom(const char* romPath, const RunOpts & opts) {
+	CoreFor<Quirks> sys(opts.headless);
+	if (opts.clockCycle)
+		sys.clockCycle = opts.clockCycle;
+	if (opts.rngSeed)
+		sys.seedRng(opts.rngSeed);
+	if (opts.speedMul > 1)
+		sys.setSpeed(opts.speedMul);
+	if (opts.recordPath)
+		sys.recording = true;
+	if (opts.replayPath && !sys.loadReplay(opts.replayPath))
+		printf("Replay log could not be loaded: %s\n", opts.replayPath);
+	if (opts.tracePath && !sys.trace.start(opts.tracePath))
+		printf("Trace file could not be opened: %s\n", opts.tracePath);
+	if (opts.breakAddr >= 0)
+		sys.setBreakpoint(u16(opts.breakAddr));
+	if (opts.watchAddr >= 0)
+		sys.setWatchpoint(u16(opts.watchAddr));
+	if (opts.breakOp >= 0)
+		sys.setOpcodeBreak(u16(opts.breakOp), opts.breakOpMask);
+	if (loadRom(sys, romPath)) {
+		if (opts.benchMillions) {
+			runBench(sys, opts.benchMillions * 1000000ull, romPath);
+		}
+		else while (sys.running) {
 			sys.op();
 		}
+		sys.dumpProfile();
+		if (opts.recordPath && !sys.saveReplay(opts.recordPath))
+			printf("Replay log could not be written: %s\n", opts.recordPath);
 	}
+	sys.trace.stop(); // Drain any buffered trace records
+	sys.disp.stopPresenter(); // The presenter must not outlive SDL
 	SDL_Quit();
 	return 0;
 }
+
+int main(int argc, char ** argv) {
+	bool microbench = false;
+	RunOpts opts;
+	const char* romPath = nullptr;
+	const char* batchDir = nullptr;
+	const char* testManifest = nullptr;
+	const char* quirks = nullptr; // nullptr == take it from the metadata cache
+	unsigned jobs = 1;
+	for (int n = 1; n < argc; ++n) {
+		if (strcmp(argv[n], "--headless") == 0)
+			opts.headless = true;
+		else if (strcmp(argv[n], "--quirks") == 0 && n + 1 < argc)
+			quirks = argv[++n];
+		else if (strcmp(argv[n], "--bench") == 0 && n + 1 < argc)
+			opts.benchMillions = strtoull(argv[++n], 0, 10);
+		else if (strcmp(argv[n], "--microbench") == 0)
+			microbench = true;
+		else if (strcmp(argv[n], "--seed") == 0 && n + 1 < argc)
+			opts.rngSeed = strtoull(argv[++n], 0, 10);
+		else if (strcmp(argv[n], "--record") == 0 && n + 1 < argc)
+			opts.recordPath = argv[++n];
+		else if (strcmp(argv[n], "--replay") == 0 && n + 1 < argc)
+			opts.replayPath = argv[++n];
+		else if (strcmp(argv[n], "--speed") == 0 && n + 1 < argc)
+			opts.speedMul = unsigned(strtoul(argv[++n], 0, 10));
+		else if (strcmp(argv[n], "--trace") == 0 && n + 1 < argc)
+			opts.tracePath = argv[++n];
+		else if (strcmp(argv[n], "--break") == 0 && n + 1 < argc)
+			opts.breakAddr = int(strtol(argv[++n], 0, 16));
+		else if (strcmp(argv[n], "--watch") == 0 && n + 1 < argc)
+			opts.watchAddr = int(strtol(argv[++n], 0, 16));
+		else if (strcmp(argv[n], "--break-op") == 0 && n + 1 < argc) { // VALUE[/MASK], hex
+			char* slash = 0;
+			opts.breakOp = strtol(argv[++n], &slash, 16);
+			if (slash && *slash == '/')
+				opts.breakOpMask = u16(strtol(slash + 1, 0, 16));
+		}
+		else if (strcmp(argv[n], "--batch") == 0 && n + 1 < argc)
+			batchDir = argv[++n];
+		else if (strcmp(argv[n], "--test") == 0 && n + 1 < argc)
+			testManifest = argv[++n];
+		else if (strcmp(argv[n], "--jobs") == 0 && n + 1 < argc)
+			jobs = unsigned(strtoul(argv[++n], 0, 10));
+		else
+			romPath = argv[n];
+	}
+
+	if (testManifest) // Headless, unthrottled, parallel; exit code is the verdict
+		return runTests(testManifest, jobs ? jobs : 1);
+
+	if (batchDir) { // One process, a worker thread per core, zero SDL video init
+		runBatch(batchDir, jobs ? jobs : 1, (opts.benchMillions ? opts.benchMillions : 10) * 1000000ull);
+		return 0;
+	}
+
+	if (microbench) {
+		runMicrobench((opts.benchMillions ? opts.benchMillions : 10) * 1000000ull);
+		SDL_Quit();
+		return 0;
+	}
+	if (romPath == nullptr) {
+		printf("usage: %s [--headless] [--quirks chip8|schip] [--bench N(millions)] [--microbench]\n"
+			"          [--seed N] [--record log] [--replay log]\n"
+			"          [--break addr] [--watch addr] [--break-op val[/mask]]\n"
+			"          [--trace file] [--speed N] [--test manifest [--jobs N]]\n"
+			"          rom  (hold space for turbo)\n", argv[0]);
+		return 1;
+	}
+
+	RomMeta meta = romMetadata(romPath); // Cached static analysis; sidecar on first run
+	if (meta.magic == RomMeta::MAGIC) {
+		opts.clockCycle = meta.clockCycle;
+		if (quirks == nullptr)
+			quirks = meta.schip ? "schip" : "chip8";
+	}
+	if (quirks == nullptr)
+		quirks = "schip";
+
+	if (strcmp(quirks, "chip8") == 0) // Pick the specialized core for this ROM
+		return runRom<QuirksChip8>(romPath, opts);
+	return runRom<QuirksSchip>(romPath, opts);
+}
@@ -0,0 +1,50 @@
+/* Offline pretty-printer for chip8emu execution traces (--trace file).
+* The emulator writes raw fixed-size records at full speed; all the text
+* formatting happens here, after the fact.
+*/
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+
+struct TraceRec { // Must match the layout written by chip8emu
+	u16 pc;
+	u16 opcode;
+	u8 regs[16];
+};
+
+int main(int argc, char ** argv) {
+	if (argc != 2) {
+		printf("usage: %s trace-file\n", argv[0]);
+		return 1;
+	}
+	FILE* f = fopen(argv[1], "rb");
+	if (f == NULL) {
+		perror("Trace file could not be opened");
+		return 1;
+	}
+	u32 header[2];
+	if (fread(header, sizeof header, 1, f) != 1 || header[0] != 0x43385452) {
+		printf("Not a chip8emu trace file: %s\n", argv[1]);
+		fclose(f);
+		return 1;
+	}
+	TraceRec recs[4096];
+	u64 n = 0;
+	size_t got;
+	while ((got = fread(recs, sizeof(TraceRec), 4096, f)) > 0) {
+		for (size_t r = 0; r < got; ++r, ++n) {
+			printf("%10llu  pc=%03x  op=%04x ", (unsigned long long)n,
+				recs[r].pc, recs[r].opcode);
+			for (int v = 0; v < 16; ++v)
+				printf(" %02x", recs[r].regs[v]);
+			printf("\n");
+		}
+	}
+	fclose(f);
+	return 0;
+}